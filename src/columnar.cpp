@@ -0,0 +1,469 @@
+#include "columnar.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+const char MAGIC[4] = {'M', 'B', 'P', 'C'};
+const uint8_t VERSION = 1;
+
+// Fixed columns preceding and following the 60 level columns
+const int NUM_HEADER_COLUMNS = 13;
+const int NUM_LEVEL_COLUMNS = 60;
+const int SYMBOL_COLUMN = NUM_HEADER_COLUMNS + NUM_LEVEL_COLUMNS;
+const int ORDER_ID_COLUMN = SYMBOL_COLUMN + 1;
+
+void putVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+uint64_t getVarint(const string& in, size_t& pos) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size()) {
+            throw runtime_error("Columnar: truncated varint");
+        }
+        uint8_t byte = in[pos++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw runtime_error("Columnar: malformed varint");
+}
+
+uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+string encodeDelta(const vector<int64_t>& values) {
+    string out;
+    int64_t prev = 0;
+    for (int64_t v : values) {
+        putVarint(out, zigzag((int64_t)((uint64_t)v - (uint64_t)prev)));
+        prev = v;
+    }
+    return out;
+}
+
+string encodeRLE(const vector<int64_t>& values) {
+    string out;
+    size_t i = 0;
+    while (i < values.size()) {
+        size_t run = 1;
+        while (i + run < values.size() && values[i + run] == values[i]) run++;
+        putVarint(out, zigzag(values[i]));
+        putVarint(out, run);
+        i += run;
+    }
+    return out;
+}
+
+vector<int64_t> decodeInts(uint8_t encoding, const string& data, size_t rows) {
+    vector<int64_t> values;
+    values.reserve(rows);
+    size_t pos = 0;
+
+    if (encoding == Columnar::DELTA) {
+        int64_t prev = 0;
+        while (values.size() < rows) {
+            prev = (int64_t)((uint64_t)prev + (uint64_t)unzigzag(getVarint(data, pos)));
+            values.push_back(prev);
+        }
+    } else if (encoding == Columnar::RLE) {
+        while (values.size() < rows) {
+            int64_t value = unzigzag(getVarint(data, pos));
+            uint64_t run = getVarint(data, pos);
+            if (run == 0 || run > rows - values.size()) {
+                throw runtime_error("Columnar: bad run length");
+            }
+            values.insert(values.end(), run, value);
+        }
+    } else {
+        throw runtime_error("Columnar: unknown integer encoding");
+    }
+    return values;
+}
+
+string encodeStrings(const vector<string>& values) {
+    vector<string> dict;
+    map<string, int64_t> index;
+    vector<int64_t> ids;
+    ids.reserve(values.size());
+    for (const auto& v : values) {
+        auto it = index.find(v);
+        if (it == index.end()) {
+            it = index.emplace(v, dict.size()).first;
+            dict.push_back(v);
+        }
+        ids.push_back(it->second);
+    }
+
+    string out;
+    putVarint(out, dict.size());
+    for (const auto& s : dict) {
+        putVarint(out, s.size());
+        out += s;
+    }
+    out += encodeRLE(ids);
+    return out;
+}
+
+vector<string> decodeStrings(const string& data, size_t rows) {
+    size_t pos = 0;
+    vector<string> dict(getVarint(data, pos));
+    for (auto& s : dict) {
+        size_t len = getVarint(data, pos);
+        if (pos + len > data.size()) {
+            throw runtime_error("Columnar: truncated dictionary");
+        }
+        s = data.substr(pos, len);
+        pos += len;
+    }
+
+    vector<int64_t> ids = decodeInts(Columnar::RLE, data.substr(pos), rows);
+    vector<string> values;
+    values.reserve(rows);
+    for (int64_t id : ids) {
+        if (id < 0 || (size_t)id >= dict.size()) {
+            throw runtime_error("Columnar: bad dictionary index");
+        }
+        values.push_back(dict[id]);
+    }
+    return values;
+}
+
+void readExact(ifstream& file, char* buf, size_t n) {
+    if (!file.read(buf, n)) {
+        throw runtime_error("Columnar: unexpected end of file");
+    }
+}
+
+uint64_t readVarint(ifstream& file) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = file.get();
+        if (byte == EOF) {
+            throw runtime_error("Columnar: unexpected end of file");
+        }
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw runtime_error("Columnar: malformed varint");
+}
+
+} // namespace
+
+namespace Columnar {
+
+const vector<ColumnInfo>& mbpColumns() {
+    static const vector<ColumnInfo> columns = [] {
+        vector<ColumnInfo> cols = {
+            {"ts_recv", INT}, {"ts_event", INT}, {"rtype", INT}, {"publisher_id", INT},
+            {"instrument_id", INT}, {"action", INT}, {"side", INT}, {"depth", INT},
+            {"price", INT}, {"size", INT}, {"flags", INT}, {"ts_in_delta", INT},
+            {"sequence", INT}
+        };
+        for (int i = 0; i < 10; i++) {
+            char suffix[4];
+            snprintf(suffix, sizeof(suffix), "%02d", i);
+            for (const char* prefix : {"bid_px_", "bid_sz_", "bid_ct_", "ask_px_", "ask_sz_", "ask_ct_"}) {
+                cols.push_back({string(prefix) + suffix, INT});
+            }
+        }
+        cols.push_back({"symbol", STRING});
+        cols.push_back({"order_id", INT});
+        return cols;
+    }();
+    return columns;
+}
+
+int64_t toFixed(double price) {
+    return llround(price * PRICE_SCALE);
+}
+
+double fromFixed(int64_t fixed) {
+    return (double)fixed / PRICE_SCALE;
+}
+
+} // namespace Columnar
+
+ColumnarWriter::ColumnarWriter(const string& filename, size_t rows_per_group)
+    : file(filename, ios::binary), rows_per_group(rows_per_group ? rows_per_group : 1),
+      int_columns(Columnar::mbpColumns().size()) {
+    if (!file) {
+        throw runtime_error("Cannot open columnar output: " + filename);
+    }
+
+    string header(MAGIC, sizeof(MAGIC));
+    header.push_back((char)VERSION);
+    const auto& columns = Columnar::mbpColumns();
+    putVarint(header, columns.size());
+    for (const auto& col : columns) {
+        putVarint(header, col.name.size());
+        header += col.name;
+        header.push_back((char)col.type);
+    }
+    file.write(header.data(), header.size());
+
+    for (auto& col : int_columns) {
+        col.reserve(this->rows_per_group);
+    }
+    symbols.reserve(this->rows_per_group);
+}
+
+ColumnarWriter::~ColumnarWriter() {
+    try {
+        finish();
+    } catch (...) {
+    }
+}
+
+void ColumnarWriter::append(const MBPRecord& record) {
+    int_columns[0].push_back(Timestamp::parse(record.ts_recv));
+    int_columns[1].push_back(record.ts_event_ns);
+    int_columns[2].push_back(record.rtype);
+    int_columns[3].push_back(record.publisher_id);
+    int_columns[4].push_back(record.instrument_id);
+    int_columns[5].push_back(record.action);
+    int_columns[6].push_back(record.side);
+    int_columns[7].push_back(record.depth);
+    int_columns[8].push_back(Columnar::toFixed(record.price));
+    int_columns[9].push_back(record.size);
+    int_columns[10].push_back(record.flags);
+    int_columns[11].push_back(record.ts_in_delta);
+    int_columns[12].push_back(record.sequence);
+
+    int c = NUM_HEADER_COLUMNS;
+    for (int i = 0; i < 10; i++) {
+        int_columns[c++].push_back(Columnar::toFixed(record.bid_prices[i]));
+        int_columns[c++].push_back(record.bid_sizes[i]);
+        int_columns[c++].push_back(record.bid_counts[i]);
+        int_columns[c++].push_back(Columnar::toFixed(record.ask_prices[i]));
+        int_columns[c++].push_back(record.ask_sizes[i]);
+        int_columns[c++].push_back(record.ask_counts[i]);
+    }
+    symbols.push_back(record.symbol);
+    int_columns[ORDER_ID_COLUMN].push_back(record.order_id);
+
+    if (++buffered_rows == rows_per_group) {
+        flushRowGroup();
+    }
+}
+
+void ColumnarWriter::flushRowGroup() {
+    if (buffered_rows == 0) return;
+
+    string group;
+    putVarint(group, buffered_rows);
+
+    const auto& columns = Columnar::mbpColumns();
+    for (size_t c = 0; c < columns.size(); c++) {
+        uint8_t encoding;
+        string data;
+        if (columns[c].type == Columnar::STRING) {
+            encoding = Columnar::DICT_RLE;
+            data = encodeStrings(symbols);
+        } else {
+            // Unchanged columns collapse to a single RLE pair; moving ones
+            // (timestamps, sequence) stay small as deltas
+            string delta = encodeDelta(int_columns[c]);
+            string rle = encodeRLE(int_columns[c]);
+            if (rle.size() < delta.size()) {
+                encoding = Columnar::RLE;
+                data = move(rle);
+            } else {
+                encoding = Columnar::DELTA;
+                data = move(delta);
+            }
+        }
+        group.push_back((char)encoding);
+        putVarint(group, data.size());
+        group += data;
+    }
+    file.write(group.data(), group.size());
+
+    for (auto& col : int_columns) col.clear();
+    symbols.clear();
+    buffered_rows = 0;
+}
+
+void ColumnarWriter::finish() {
+    if (finished) return;
+    flushRowGroup();
+
+    string trailer;
+    putVarint(trailer, 0);
+    file.write(trailer.data(), trailer.size());
+    file.flush();
+    finished = true;
+
+    if (!file) {
+        throw runtime_error("Columnar: write failed");
+    }
+}
+
+void ColumnarWriter::writeMBP(const vector<MBPRecord>& records, const string& filename) {
+    ColumnarWriter writer(filename);
+    for (const auto& record : records) {
+        writer.append(record);
+    }
+    writer.finish();
+}
+
+ColumnarReader::ColumnarReader(const string& filename) : file(filename, ios::binary) {
+    if (!file) {
+        throw runtime_error("Cannot open columnar input: " + filename);
+    }
+
+    char magic[sizeof(MAGIC)];
+    readExact(file, magic, sizeof(magic));
+    if (!equal(magic, magic + sizeof(magic), MAGIC)) {
+        throw runtime_error("Columnar: not an MBPC file: " + filename);
+    }
+    if (file.get() != VERSION) {
+        throw runtime_error("Columnar: unsupported version in " + filename);
+    }
+
+    columns.resize(readVarint(file));
+    for (auto& col : columns) {
+        col.name.resize(readVarint(file));
+        readExact(file, &col.name[0], col.name.size());
+        int type = file.get();
+        if (type != Columnar::INT && type != Columnar::STRING) {
+            throw runtime_error("Columnar: unknown type for column " + col.name + " in " + filename);
+        }
+        col.type = (Columnar::ColumnType)type;
+    }
+}
+
+bool ColumnarReader::nextRowGroup(const vector<string>& selected, ColumnarBatch& batch) {
+    batch = ColumnarBatch();
+    if (saw_trailer) return false;
+
+    // Only the num_rows == 0 trailer ends a file; running out of bytes
+    // before it means the file was cut off
+    if (file.peek() == EOF) {
+        throw runtime_error("Columnar: unexpected end of file");
+    }
+    batch.rows = readVarint(file);
+    if (batch.rows == 0) {
+        saw_trailer = true;
+        return false;
+    }
+
+    string data;
+    for (const auto& col : columns) {
+        uint8_t encoding = (uint8_t)file.get();
+        size_t len = readVarint(file);
+
+        bool wanted = selected.empty() ||
+                      find(selected.begin(), selected.end(), col.name) != selected.end();
+        if (!wanted) {
+            file.seekg(len, ios::cur);
+            continue;
+        }
+
+        data.resize(len);
+        readExact(file, &data[0], len);
+        if (col.type == Columnar::STRING) {
+            batch.string_columns[col.name] = decodeStrings(data, batch.rows);
+        } else {
+            batch.int_columns[col.name] = decodeInts(encoding, data, batch.rows);
+        }
+    }
+
+    if (!file) {
+        throw runtime_error("Columnar: unexpected end of file");
+    }
+    return true;
+}
+
+map<string, vector<int64_t>> ColumnarReader::scanColumns(const vector<string>& selected) {
+    map<string, vector<int64_t>> result;
+    for (const auto& name : selected) {
+        auto it = find_if(columns.begin(), columns.end(),
+                          [&](const Columnar::ColumnInfo& col) { return col.name == name; });
+        if (it == columns.end()) {
+            throw runtime_error("Columnar: no column named " + name);
+        }
+        if (it->type != Columnar::INT) {
+            throw runtime_error("Columnar: column " + name + " is not an integer column");
+        }
+        result[name];
+    }
+
+    ColumnarBatch batch;
+    while (nextRowGroup(selected, batch)) {
+        for (auto& [name, values] : batch.int_columns) {
+            auto& out = result[name];
+            out.insert(out.end(), values.begin(), values.end());
+        }
+    }
+    return result;
+}
+
+vector<MBPRecord> ColumnarReader::readMBP(const string& filename) {
+    ColumnarReader reader(filename);
+    vector<MBPRecord> records;
+
+    const auto& expected = Columnar::mbpColumns();
+    bool layout_matches = reader.columns.size() == expected.size();
+    for (size_t c = 0; layout_matches && c < expected.size(); c++) {
+        layout_matches = reader.columns[c].name == expected[c].name &&
+                         reader.columns[c].type == expected[c].type;
+    }
+    if (!layout_matches) {
+        throw runtime_error("Columnar: unexpected column layout in " + filename);
+    }
+
+    ColumnarBatch batch;
+    while (reader.nextRowGroup({}, batch)) {
+        vector<const vector<int64_t>*> cols;
+        for (const auto& col : reader.columns) {
+            cols.push_back(col.type == Columnar::INT ? &batch.int_columns[col.name] : nullptr);
+        }
+        const auto& symbols = batch.string_columns["symbol"];
+
+        for (size_t r = 0; r < batch.rows; r++) {
+            MBPRecord mbp;
+            mbp.ts_recv = Timestamp::format((*cols[0])[r]);
+            mbp.ts_event = Timestamp::format((*cols[1])[r]);
+            mbp.rtype = (*cols[2])[r];
+            mbp.publisher_id = (*cols[3])[r];
+            mbp.instrument_id = (*cols[4])[r];
+            mbp.action = (char)(*cols[5])[r];
+            mbp.side = (char)(*cols[6])[r];
+            mbp.depth = (*cols[7])[r];
+            mbp.price = Columnar::fromFixed((*cols[8])[r]);
+            mbp.size = (*cols[9])[r];
+            mbp.flags = (*cols[10])[r];
+            mbp.ts_in_delta = (*cols[11])[r];
+            mbp.sequence = (*cols[12])[r];
+
+            int c = NUM_HEADER_COLUMNS;
+            for (int i = 0; i < 10; i++) {
+                mbp.bid_prices[i] = Columnar::fromFixed((*cols[c++])[r]);
+                mbp.bid_sizes[i] = (*cols[c++])[r];
+                mbp.bid_counts[i] = (*cols[c++])[r];
+                mbp.ask_prices[i] = Columnar::fromFixed((*cols[c++])[r]);
+                mbp.ask_sizes[i] = (*cols[c++])[r];
+                mbp.ask_counts[i] = (*cols[c++])[r];
+            }
+            mbp.symbol = symbols[r];
+            mbp.order_id = (*cols[ORDER_ID_COLUMN])[r];
+            records.push_back(move(mbp));
+        }
+    }
+    return records;
+}
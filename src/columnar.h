@@ -0,0 +1,87 @@
+#pragma once
+#include "orderbook.h"
+#include <cstdint>
+
+using namespace std;
+
+// Columnar MBP-10 file format (.mbpc)
+//
+//   header:    "MBPC" | version:u8 | num_columns:varint | {name_len:varint name type:u8}*
+//   row group: num_rows:varint | {encoding:u8 byte_len:varint data}* per column
+//   trailer:   num_rows == 0
+//
+// Integer columns hold timestamps as ns since epoch (see Timestamp), prices
+// as fixed-point (1e-9 units) and everything else as-is. Each column in a row
+// group is written with whichever encoding is smaller:
+//   DELTA - zig-zag varint of the difference to the previous row
+//   RLE   - (zig-zag varint value, varint run length) pairs
+// String columns (symbol) use a per-group dictionary with RLE indices.
+// byte_len lets a reader skip columns it was not asked for.
+namespace Columnar {
+    enum ColumnType : uint8_t { INT = 0, STRING = 1 };
+    enum Encoding : uint8_t { DELTA = 0, RLE = 1, DICT_RLE = 2 };
+
+    const int64_t PRICE_SCALE = 1000000000LL;
+
+    struct ColumnInfo {
+        string name;
+        ColumnType type;
+    };
+
+    // Column layout matching the CSV header written by CSVProcessor::writeMBP
+    const vector<ColumnInfo>& mbpColumns();
+
+    int64_t toFixed(double price);
+    double fromFixed(int64_t fixed);
+}
+
+class ColumnarWriter {
+private:
+    ofstream file;
+    size_t rows_per_group;
+    size_t buffered_rows = 0;
+    vector<vector<int64_t>> int_columns;
+    vector<string> symbols;
+    bool finished = false;
+
+    void flushRowGroup();
+
+public:
+    explicit ColumnarWriter(const string& filename, size_t rows_per_group = 65536);
+    ~ColumnarWriter();
+
+    void append(const MBPRecord& record);
+    void finish();
+
+    static void writeMBP(const vector<MBPRecord>& records, const string& filename);
+};
+
+// Decoded row group; only the requested columns are populated
+struct ColumnarBatch {
+    size_t rows = 0;
+    map<string, vector<int64_t>> int_columns;
+    map<string, vector<string>> string_columns;
+};
+
+class ColumnarReader {
+private:
+    ifstream file;
+    vector<Columnar::ColumnInfo> columns;
+    bool saw_trailer = false;
+
+public:
+    explicit ColumnarReader(const string& filename);
+
+    const vector<Columnar::ColumnInfo>& columnInfo() const { return columns; }
+
+    // Decodes the next row group, skipping columns not listed in `selected`
+    // (an empty list selects everything). Returns false after the trailer;
+    // throws if the file ends without one.
+    bool nextRowGroup(const vector<string>& selected, ColumnarBatch& batch);
+
+    // Scans the remaining row groups and concatenates the selected integer
+    // columns. Throws if a name is not in columnInfo() or is not an INT column.
+    map<string, vector<int64_t>> scanColumns(const vector<string>& selected);
+
+    static vector<MBPRecord> readMBP(const string& filename);
+};
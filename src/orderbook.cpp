@@ -1,9 +1,109 @@
 #include "orderbook.h"
 #include <algorithm>
+#include <cstdio>
 #include <iomanip>
+#include <stdexcept>
 
 using namespace std;
 
+namespace {
+
+// Howard Hinnant's days_from_civil / civil_from_days
+int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+void civilFromDays(int64_t z, int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = (int64_t)yoe + era * 400 + (m <= 2);
+}
+
+int parseDigits(const string& ts, size_t pos, size_t count) {
+    int value = 0;
+    for (size_t i = pos; i < pos + count; i++) {
+        if (!isdigit((unsigned char)ts[i])) {
+            throw runtime_error("Bad timestamp: " + ts);
+        }
+        value = value * 10 + (ts[i] - '0');
+    }
+    return value;
+}
+
+} // namespace
+
+namespace Timestamp {
+
+int64_t parse(const string& ts) {
+    if (ts.empty()) return 0;
+
+    // Fixed layout "YYYY-MM-DDTHH:MM:SS", then an optional fraction
+    if (ts.size() < 19 || ts[4] != '-' || ts[7] != '-' || ts[10] != 'T' ||
+        ts[13] != ':' || ts[16] != ':') {
+        throw runtime_error("Bad timestamp: " + ts);
+    }
+    int year = parseDigits(ts, 0, 4);
+    int month = parseDigits(ts, 5, 2);
+    int day = parseDigits(ts, 8, 2);
+    int hour = parseDigits(ts, 11, 2);
+    int minute = parseDigits(ts, 14, 2);
+    int second = parseDigits(ts, 17, 2);
+
+    int64_t nanos = 0;
+    size_t pos = 19;
+    if (pos < ts.size() && ts[pos] == '.') {
+        int digits = 0;
+        for (pos++; pos < ts.size() && isdigit((unsigned char)ts[pos]); pos++, digits++) {
+            if (digits < 9) nanos = nanos * 10 + (ts[pos] - '0');
+        }
+        for (; digits < 9; digits++) nanos *= 10;
+    }
+
+    int64_t days = daysFromCivil(year, month, day);
+    return ((days * 24 + hour) * 60 + minute) * 60 * 1000000000LL
+           + second * 1000000000LL + nanos;
+}
+
+string format(int64_t ns) {
+    if (ns == 0) return "";
+
+    int64_t secs = ns / 1000000000LL;
+    int64_t nanos = ns % 1000000000LL;
+    if (nanos < 0) {
+        nanos += 1000000000LL;
+        secs -= 1;
+    }
+    int64_t days = secs / 86400;
+    int64_t rem = secs % 86400;
+    if (rem < 0) {
+        rem += 86400;
+        days -= 1;
+    }
+
+    int64_t year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%04lld-%02u-%02uT%02lld:%02lld:%02lld.%09lldZ",
+             (long long)year, month, day, (long long)(rem / 3600),
+             (long long)(rem / 60 % 60), (long long)(rem % 60), (long long)nanos);
+    return buf;
+}
+
+} // namespace Timestamp
+
 void OrderBook::addOrder(char side, double price, int size, long order_id) {
     if (side == 'B') {
         bids[price].first += size;
@@ -65,6 +165,7 @@ MBPRecord OrderBook::generateMBP(const MBORecord& mbo_record) {
     // Copy basic fields
     mbp.ts_recv = mbo_record.ts_recv;
     mbp.ts_event = mbo_record.ts_event;
+    mbp.ts_event_ns = mbo_record.ts_event_ns;
     mbp.rtype = 10; // MBP type
     mbp.publisher_id = mbo_record.publisher_id;
     mbp.instrument_id = mbo_record.instrument_id;
@@ -147,7 +248,7 @@ MBORecord CSVProcessor::parseMBOLine(const string& line) {
     while (getline(ss, cell, ',')) {
         switch (field) {
             case 0: record.ts_recv = cell; break;
-            case 1: record.ts_event = cell; break;
+            case 1: record.ts_event = cell; record.ts_event_ns = Timestamp::parse(cell); break;
             case 2: record.rtype = stoi(cell); break;
             case 3: record.publisher_id = stoi(cell); break;
             case 4: record.instrument_id = stoi(cell); break;
@@ -237,3 +338,117 @@ string CSVProcessor::formatMBPLine(const MBPRecord& record, int index) {
     
     return ss.str();
 }
+
+vector<MBPRecord> Reconstructor::process(const vector<MBORecord>& mbo_records, bool verbose,
+                                         const function<void(const MBPRecord&)>& on_snapshot) {
+    OrderBook book;
+    vector<MBPRecord> mbp_records;
+    
+    auto emit = [&](MBPRecord&& mbp) {
+        if (on_snapshot) {
+            on_snapshot(mbp);
+        }
+        mbp_records.push_back(move(mbp));
+    };
+    
+    // Skip first record if it's a clear action
+    size_t start_idx = 0;
+    if (!mbo_records.empty() && mbo_records[0].action == 'R') {
+        start_idx = 1;
+        if (verbose) {
+            cout << "Skipping initial clear action" << endl;
+        }
+    }
+    
+    // Track pending trades for T->F->C sequence handling
+    struct PendingTrade {
+        MBORecord trade_record;
+        bool has_fill = false;
+        bool has_cancel = false;
+    };
+    
+    map<long, PendingTrade> pending_trades;
+    
+    for (size_t i = start_idx; i < mbo_records.size(); i++) {
+        const auto& record = mbo_records[i];
+        
+        if (record.action == 'A') {
+            // Add order
+            book.addOrder(record.side, record.price, record.size, record.order_id);
+            emit(book.generateMBP(record));
+            
+        } else if (record.action == 'C') {
+            // Check if this is part of a T->F->C sequence
+            bool is_trade_cancel = false;
+            for (auto& [order_id, pending] : pending_trades) {
+                if (pending.trade_record.price == record.price && 
+                    pending.trade_record.side == record.side) {
+                    // This cancel completes a trade sequence
+                    pending.has_cancel = true;
+                    is_trade_cancel = true;
+                    
+                    // Apply the trade (remove liquidity from opposite side)
+                    char opposite_side = (record.side == 'B') ? 'A' : 'B';
+                    book.handleTrade(opposite_side, record.price, pending.trade_record.size);
+                    
+                    // Create MBP record for the trade
+                    MBORecord trade_for_mbp = pending.trade_record;
+                    trade_for_mbp.action = 'T';
+                    trade_for_mbp.side = opposite_side; // Correct the side
+                    emit(book.generateMBP(trade_for_mbp));
+                    
+                    // Clean up
+                    pending_trades.erase(order_id);
+                    break;
+                }
+            }
+            
+            if (!is_trade_cancel) {
+                // Regular cancel
+                book.cancelOrder(record.order_id, record.side, record.price, record.size);
+                emit(book.generateMBP(record));
+            }
+            
+        } else if (record.action == 'T') {
+            // Trade - check if side is 'N' (should be ignored)
+            if (record.side == 'N') {
+                continue;
+            }
+            
+            // Start tracking this trade for potential T->F->C sequence
+            pending_trades[record.order_id] = {record, false, false};
+            
+        } else if (record.action == 'F') {
+            // Fill - mark the pending trade
+            if (pending_trades.count(record.order_id)) {
+                pending_trades[record.order_id].has_fill = true;
+            }
+            
+        } else if (record.action == 'R') {
+            // Clear the book
+            book.clear();
+            emit(book.generateMBP(record));
+        }
+        
+        // Progress indicator
+        if (verbose && i % 10000 == 0) {
+            cout << "Processed " << i << "/" << mbo_records.size() << " records" << endl;
+        }
+    }
+    
+    // Handle any remaining pending trades (unlikely in well-formed data)
+    for (const auto& [order_id, pending] : pending_trades) {
+        if (pending.has_fill) {
+            // Apply the trade even if cancel is missing
+            char opposite_side = (pending.trade_record.side == 'B') ? 'A' : 'B';
+            book.handleTrade(opposite_side, pending.trade_record.price, pending.trade_record.size);
+            
+            MBORecord trade_for_mbp = pending.trade_record;
+            trade_for_mbp.action = 'T';
+            trade_for_mbp.side = opposite_side;
+            emit(book.generateMBP(trade_for_mbp));
+        }
+    }
+    
+    return mbp_records;
+}
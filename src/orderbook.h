@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include <map>
 #include <string>
 #include <vector>
@@ -6,12 +7,20 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <cstdint>
 
 using namespace std;
 
+// ISO-8601 "YYYY-MM-DDTHH:MM:SS.fffffffffZ" <-> ns since epoch; "" <-> 0
+namespace Timestamp {
+    int64_t parse(const string& ts);
+    string format(int64_t ns);
+}
+
 struct MBORecord {
     string ts_recv;
     string ts_event;
+    int64_t ts_event_ns = 0;  // ts_event parsed once at read time
     int rtype;
     int publisher_id;
     int instrument_id;
@@ -30,6 +39,7 @@ struct MBORecord {
 struct MBPRecord {
     string ts_recv;
     string ts_event;
+    int64_t ts_event_ns = 0;
     int rtype;
     int publisher_id;
     int instrument_id;
@@ -82,4 +92,12 @@ public:
     static void writeMBP(const vector<MBPRecord>& records, const string& filename);
     static MBORecord parseMBOLine(const string& line);
     static string formatMBPLine(const MBPRecord& record, int index);
+};
+
+class Reconstructor {
+public:
+    // Replays MBO records through an OrderBook and returns the MBP-10 snapshots.
+    // on_snapshot, if set, sees each snapshot as soon as it is generated.
+    static vector<MBPRecord> process(const vector<MBORecord>& mbo_records, bool verbose = true,
+                                     const function<void(const MBPRecord&)>& on_snapshot = nullptr);
 };
\ No newline at end of file
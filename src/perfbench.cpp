@@ -0,0 +1,594 @@
+#include "orderbook.h"
+#include "columnar.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+// A counter value for one measured interval; -1 if unavailable. `scaled`
+// marks values extrapolated from time_enabled/time_running because the PMU
+// multiplexed the group with other events.
+struct CounterSample {
+    long long value = -1;
+    bool scaled = false;
+};
+
+// Hardware/software counters read through perf_event_open. All events are
+// opened as one group led by cycles, so they are enabled, disabled and
+// (if the PMU is oversubscribed) multiplexed together and every ratio such
+// as ipc covers the same interval. Events the CPU or VM does not support
+// are left out of the group and reported as "n/a".
+class PerfCounters {
+public:
+    enum Counter { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, PAGE_FAULTS, NUM_COUNTERS };
+
+    PerfCounters() {
+        open(CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(L1D_MISSES, PERF_TYPE_HW_CACHE,
+             PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        open(LLC_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        open(BRANCH_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        open(PAGE_FAULTS, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+    }
+
+    ~PerfCounters() {
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    void start() {
+        if (leader() >= 0) {
+            ioctl(leader(), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+        for (int fd : solo_fds()) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    vector<CounterSample> stop() {
+        vector<CounterSample> samples(NUM_COUNTERS);
+        if (leader() >= 0) {
+            ioctl(leader(), PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            readGroup(samples);
+        }
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            if (fds[i] < 0 || grouped[i]) continue;
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t buf[3]; // value, time_enabled, time_running
+            if (read(fds[i], buf, sizeof(buf)) == sizeof(buf)) {
+                samples[i] = scale(buf[0], buf[1], buf[2]);
+            }
+        }
+        return samples;
+    }
+
+    // True if any hardware event opened; the software page-fault event opens
+    // even when the PMU is blocked, so it does not count
+    bool hardwareAvailable() const {
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            if (i != PAGE_FAULTS && fds[i] >= 0) return true;
+        }
+        return false;
+    }
+
+    static const char* name(int counter) {
+        static const char* names[NUM_COUNTERS] = {
+            "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "page_faults"
+        };
+        return names[counter];
+    }
+
+private:
+    int fds[NUM_COUNTERS] = {-1, -1, -1, -1, -1, -1};
+    bool grouped[NUM_COUNTERS] = {};
+    uint64_t ids[NUM_COUNTERS] = {};
+
+    // Group leader, or -1 if cycles is unsupported and events run standalone
+    int leader() const {
+        return grouped[CYCLES] ? fds[CYCLES] : -1;
+    }
+
+    vector<int> solo_fds() const {
+        vector<int> result;
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            if (fds[i] >= 0 && !grouped[i]) result.push_back(fds[i]);
+        }
+        return result;
+    }
+
+    static CounterSample scale(uint64_t value, uint64_t enabled, uint64_t running) {
+        CounterSample sample;
+        if (running == 0) {
+            return sample; // never scheduled on the PMU
+        }
+        if (running < enabled) {
+            sample.value = (long long)((double)value * enabled / running);
+            sample.scaled = true;
+        } else {
+            sample.value = (long long)value;
+        }
+        return sample;
+    }
+
+    void readGroup(vector<CounterSample>& samples) {
+        // PERF_FORMAT_GROUP | ID | TOTAL_TIME_*: nr, enabled, running, {value, id}[nr]
+        uint64_t buf[3 + 2 * NUM_COUNTERS];
+        ssize_t n = read(leader(), buf, sizeof(buf));
+        if (n < (ssize_t)(3 * sizeof(uint64_t))) return;
+
+        uint64_t nr = min<uint64_t>(buf[0], NUM_COUNTERS);
+        for (uint64_t e = 0; e < nr; e++) {
+            uint64_t value = buf[3 + 2 * e];
+            uint64_t id = buf[4 + 2 * e];
+            for (int i = 0; i < NUM_COUNTERS; i++) {
+                if (grouped[i] && ids[i] == id) {
+                    samples[i] = scale(value, buf[1], buf[2]);
+                }
+            }
+        }
+    }
+
+    void open(Counter counter, uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.exclude_kernel = 1; // allowed with perf_event_paranoid <= 2
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // Only the leader starts disabled; members follow its enable state
+        int group_fd = leader();
+        if (counter == CYCLES) {
+            attr.disabled = 1;
+            attr.read_format |= PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+        } else if (group_fd < 0) {
+            attr.disabled = 1;
+        } else {
+            attr.read_format |= PERF_FORMAT_ID;
+        }
+
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, counter == CYCLES ? -1 : group_fd, 0);
+        if (fd < 0) return;
+
+        fds[counter] = fd;
+        grouped[counter] = counter == CYCLES || group_fd >= 0;
+        if (grouped[counter]) {
+            ioctl(fd, PERF_EVENT_IOC_ID, &ids[counter]);
+        }
+    }
+};
+
+struct StageResult {
+    string dataset;
+    string stage;
+    size_t records;
+    size_t bytes;
+    double seconds;
+    vector<CounterSample> counters;
+
+    bool multiplexed() const {
+        for (const auto& c : counters) {
+            if (c.scaled) return true;
+        }
+        return false;
+    }
+
+    double recordsPerSec() const { return seconds > 0 ? records / seconds : 0.0; }
+    double nsPerRecord() const { return records > 0 ? seconds * 1e9 / records : 0.0; }
+    double bytesPerSec() const { return seconds > 0 ? bytes / seconds : 0.0; }
+};
+
+struct BenchConfig {
+    vector<size_t> sizes = {10000, 100000, 1000000};
+    vector<int> instruments = {1, 16};
+    int repeat = 3;
+    string save_file;
+    string baseline_file;
+    double threshold_pct = 10.0;
+    string work_dir = ".";
+};
+
+// Generates a synthetic MBO CSV resembling the sample feed: an initial clear,
+// then adds, cancels and T->F->C trade sequences spread over several instruments.
+static void generateDataset(const string& filename, size_t num_records, int num_instruments) {
+    ofstream file(filename);
+    file << "ts_recv,ts_event,rtype,publisher_id,instrument_id,action,side,price,size,channel_id,order_id,flags,ts_in_delta,sequence,symbol\n";
+
+    mt19937_64 rng(num_records * 131 + num_instruments);
+
+    struct RestingOrder {
+        long order_id;
+        char side;
+        int ticks;
+        int size;
+    };
+    vector<vector<RestingOrder>> resting(num_instruments);
+
+    long next_order_id = 1000;
+    long sequence = 1;
+    long long ts_ns = 8LL * 3600 * 1000000000LL; // 08:00:00 UTC
+
+    auto write = [&](int inst, char action, char side, int ticks, int size, long order_id) {
+        ts_ns += 1000 + rng() % 50000;
+        long long secs = ts_ns / 1000000000LL;
+        long long nanos = ts_ns % 1000000000LL;
+        char ts[64];
+        snprintf(ts, sizeof(ts), "2025-07-17T%02lld:%02lld:%02lld.%09lldZ",
+                 (secs / 3600) % 24, (secs / 60) % 60, secs % 60, nanos);
+        file << ts << "," << ts << ",160,2," << (1100 + inst) << ","
+             << action << "," << side << ",";
+        if (ticks > 0) {
+            file << fixed << setprecision(9) << ticks * 0.01;
+        }
+        file << "," << size << ",0," << order_id << ",130,165200," << sequence++
+             << ",S" << inst << "\n";
+    };
+
+    write(0, 'R', 'N', 0, 0, 0);
+
+    size_t written = 1;
+    while (written < num_records) {
+        int inst = rng() % num_instruments;
+        auto& orders = resting[inst];
+        unsigned roll = rng() % 100;
+
+        if (orders.size() < 20 || roll < 55) {
+            char side = (rng() & 1) ? 'B' : 'A';
+            int ticks = side == 'B' ? 500 - (int)(rng() % 25) : 501 + (int)(rng() % 25);
+            int size = 100 * (1 + rng() % 10);
+            orders.push_back({next_order_id++, side, ticks, size});
+            write(inst, 'A', side, ticks, size, orders.back().order_id);
+            written++;
+        } else if (roll < 90) {
+            size_t idx = rng() % orders.size();
+            RestingOrder order = orders[idx];
+            orders[idx] = orders.back();
+            orders.pop_back();
+            write(inst, 'C', order.side, order.ticks, order.size, order.order_id);
+            written++;
+        } else {
+            // Aggressor trades against a resting order: T on the aggressor side
+            // without an order id, F and C on the resting side
+            size_t idx = rng() % orders.size();
+            RestingOrder order = orders[idx];
+            orders[idx] = orders.back();
+            orders.pop_back();
+            char aggressor = order.side == 'B' ? 'A' : 'B';
+            write(inst, 'T', aggressor, order.ticks, order.size, 0);
+            write(inst, 'F', order.side, order.ticks, order.size, order.order_id);
+            write(inst, 'C', order.side, order.ticks, order.size, order.order_id);
+            written += 3;
+        }
+    }
+}
+
+static size_t fileSize(const string& filename) {
+    ifstream file(filename, ios::binary | ios::ate);
+    return file ? (size_t)file.tellg() : 0;
+}
+
+template <typename Fn>
+static StageResult runStage(PerfCounters& perf, const string& dataset, const string& stage,
+                            int repeat, Fn&& fn) {
+    StageResult best;
+    best.dataset = dataset;
+    best.stage = stage;
+    best.seconds = -1;
+
+    // Keep the fastest repetition to reduce scheduling noise
+    for (int r = 0; r < repeat; r++) {
+        perf.start();
+        auto start = chrono::steady_clock::now();
+        pair<size_t, size_t> processed = fn();
+        auto end = chrono::steady_clock::now();
+        vector<CounterSample> counters = perf.stop();
+
+        double seconds = chrono::duration<double>(end - start).count();
+        if (best.seconds < 0 || seconds < best.seconds) {
+            best.records = processed.first;
+            best.bytes = processed.second;
+            best.seconds = seconds;
+            best.counters = counters;
+        }
+    }
+    return best;
+}
+
+static void printResult(const StageResult& result) {
+    cout << "  " << left << setw(12) << result.stage << right
+         << fixed << setprecision(0)
+         << setw(14) << result.recordsPerSec() << " rec/s"
+         << setprecision(1) << setw(10) << result.nsPerRecord() << " ns/rec"
+         << setprecision(1) << setw(10) << result.bytesPerSec() / 1e6 << " MB/s" << endl;
+
+    const auto& counters = result.counters;
+    cout << "  " << setw(12) << "";
+    for (int i = 0; i < PerfCounters::NUM_COUNTERS; i++) {
+        cout << " " << PerfCounters::name(i) << "=";
+        if (counters[i].value < 0) {
+            cout << "n/a";
+        } else {
+            cout << counters[i].value << (counters[i].scaled ? "*" : "");
+        }
+    }
+    if (counters[PerfCounters::CYCLES].value > 0 && counters[PerfCounters::INSTRUCTIONS].value >= 0) {
+        cout << " ipc=" << setprecision(2)
+             << (double)counters[PerfCounters::INSTRUCTIONS].value / counters[PerfCounters::CYCLES].value;
+    }
+    if (result.multiplexed()) {
+        cout << "  (* scaled, counters were multiplexed)";
+    }
+    cout << endl;
+}
+
+static void writeJSON(const vector<StageResult>& results, const string& filename) {
+    ofstream file(filename);
+    file << "{\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& r = results[i];
+        file << "    {\"dataset\": \"" << r.dataset << "\", \"stage\": \"" << r.stage << "\""
+             << fixed << setprecision(3)
+             << ", \"records\": " << r.records
+             << ", \"bytes\": " << r.bytes
+             << ", \"records_per_sec\": " << r.recordsPerSec()
+             << ", \"ns_per_record\": " << r.nsPerRecord()
+             << ", \"bytes_per_sec\": " << r.bytesPerSec();
+        for (int c = 0; c < PerfCounters::NUM_COUNTERS; c++) {
+            file << ", \"" << PerfCounters::name(c) << "\": ";
+            if (r.counters[c].value < 0) {
+                file << "null";
+            } else {
+                file << r.counters[c].value;
+            }
+        }
+        file << ", \"multiplexed\": " << (r.multiplexed() ? "true" : "false");
+        file << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+}
+
+// Minimal reader for the files produced by writeJSON: one result object per line
+static map<string, double> readBaseline(const string& filename) {
+    ifstream file(filename);
+    if (!file) {
+        throw runtime_error("Cannot open baseline file: " + filename);
+    }
+
+    auto stringField = [](const string& line, const string& key) {
+        size_t pos = line.find("\"" + key + "\": \"");
+        if (pos == string::npos) return string();
+        pos += key.size() + 5;
+        return line.substr(pos, line.find('"', pos) - pos);
+    };
+
+    map<string, double> baseline;
+    string line;
+    while (getline(file, line)) {
+        string dataset = stringField(line, "dataset");
+        string stage = stringField(line, "stage");
+        size_t pos = line.find("\"records_per_sec\": ");
+        if (dataset.empty() || stage.empty() || pos == string::npos) continue;
+        baseline[dataset + "/" + stage] = stod(line.substr(pos + 19));
+    }
+    return baseline;
+}
+
+// Parses a comma-separated list of positive integers; false on anything else
+static bool parsePositiveList(const string& arg, long max_value, vector<size_t>& values) {
+    values.clear();
+    stringstream ss(arg);
+    string cell;
+    while (getline(ss, cell, ',')) {
+        size_t consumed = 0;
+        long value;
+        try {
+            value = stol(cell, &consumed);
+        } catch (const exception&) {
+            return false;
+        }
+        if (consumed != cell.size() || value <= 0 || value > max_value) {
+            return false;
+        }
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+// Parses a finite number >= 0; false on anything else
+static bool parseNonNegative(const string& arg, double& value) {
+    size_t consumed = 0;
+    try {
+        value = stod(arg, &consumed);
+    } catch (const exception&) {
+        return false;
+    }
+    return consumed == arg.size() && isfinite(value) && value >= 0;
+}
+
+static void usage(const char* prog) {
+    cerr << "Usage: " << prog << " [options]\n"
+         << "  --sizes N,N,...         records per generated dataset (default 10000,100000,1000000)\n"
+         << "  --instruments N,N,...   instruments per generated dataset (default 1,16)\n"
+         << "  --repeat N              repetitions per stage, fastest is kept (default 3)\n"
+         << "  --save FILE             write results as baseline JSON\n"
+         << "  --baseline FILE         compare against baseline JSON\n"
+         << "  --threshold PCT         allowed throughput regression in percent (default 10)\n"
+         << "  --workdir DIR           where generated datasets are written (default .)" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                return 2;
+            }
+            string value = argv[++i];
+            if (arg == "--sizes") {
+                if (!parsePositiveList(value, numeric_limits<long>::max(), config.sizes)) {
+                    cerr << "--sizes needs a list of positive record counts" << endl;
+                    usage(argv[0]);
+                    return 2;
+                }
+            } else if (arg == "--instruments") {
+                vector<size_t> instruments;
+                if (!parsePositiveList(value, numeric_limits<int>::max(), instruments)) {
+                    cerr << "--instruments needs a list of positive instrument counts" << endl;
+                    usage(argv[0]);
+                    return 2;
+                }
+                config.instruments.assign(instruments.begin(), instruments.end());
+            } else if (arg == "--repeat") {
+                vector<size_t> repeat;
+                if (!parsePositiveList(value, 1000000, repeat) || repeat.size() != 1) {
+                    cerr << "--repeat needs a positive count" << endl;
+                    usage(argv[0]);
+                    return 2;
+                }
+                config.repeat = (int)repeat[0];
+            } else if (arg == "--save") {
+                config.save_file = value;
+            } else if (arg == "--baseline") {
+                config.baseline_file = value;
+            } else if (arg == "--threshold") {
+                if (!parseNonNegative(value, config.threshold_pct)) {
+                    cerr << "--threshold needs a non-negative percentage" << endl;
+                    usage(argv[0]);
+                    return 2;
+                }
+            } else if (arg == "--workdir") {
+                config.work_dir = value;
+            } else {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+
+        PerfCounters perf;
+        if (!perf.hardwareAvailable()) {
+            cerr << "Warning: hardware counters unavailable through perf_event_open "
+                 << "(check kernel.perf_event_paranoid or VM PMU support); "
+                 << "reporting wall-clock and page faults only" << endl;
+        }
+
+        vector<StageResult> results;
+
+        for (size_t size : config.sizes) {
+            for (int instruments : config.instruments) {
+                string dataset = "n" + to_string(size) + "_i" + to_string(instruments);
+                string input_file = config.work_dir + "/perfbench_" + dataset + ".csv";
+                string output_file = config.work_dir + "/perfbench_" + dataset + "_mbp.csv";
+                string columnar_file = config.work_dir + "/perfbench_" + dataset + "_mbp.mbpc";
+
+                generateDataset(input_file, size, instruments);
+                size_t input_bytes = fileSize(input_file);
+
+                cout << "Dataset " << dataset << " (" << input_bytes << " bytes)" << endl;
+
+                vector<MBORecord> mbo_records;
+                vector<MBPRecord> mbp_records;
+
+                results.push_back(runStage(perf, dataset, "read", config.repeat, [&]() {
+                    mbo_records = CSVProcessor::readMBO(input_file);
+                    return make_pair(mbo_records.size(), input_bytes);
+                }));
+                printResult(results.back());
+
+                // Bytes for the in-memory stage are the CSV bytes it consumes
+                results.push_back(runStage(perf, dataset, "reconstruct", config.repeat, [&]() {
+                    mbp_records = Reconstructor::process(mbo_records, false);
+                    return make_pair(mbo_records.size(), input_bytes);
+                }));
+                printResult(results.back());
+
+                results.push_back(runStage(perf, dataset, "write", config.repeat, [&]() {
+                    CSVProcessor::writeMBP(mbp_records, output_file);
+                    return make_pair(mbp_records.size(), fileSize(output_file));
+                }));
+                printResult(results.back());
+
+                results.push_back(runStage(perf, dataset, "write_mbpc", config.repeat, [&]() {
+                    ColumnarWriter::writeMBP(mbp_records, columnar_file);
+                    return make_pair(mbp_records.size(), fileSize(columnar_file));
+                }));
+                printResult(results.back());
+
+                remove(input_file.c_str());
+                remove(output_file.c_str());
+                remove(columnar_file.c_str());
+            }
+        }
+
+        if (!config.save_file.empty()) {
+            writeJSON(results, config.save_file);
+            cout << "Baseline written to: " << config.save_file << endl;
+        }
+
+        if (!config.baseline_file.empty()) {
+            auto baseline = readBaseline(config.baseline_file);
+            if (baseline.empty()) {
+                cerr << "No results found in baseline " << config.baseline_file << endl;
+                return 1;
+            }
+            bool regressed = false;
+            int missing = 0;
+
+            cout << "Comparing against " << config.baseline_file
+                 << " (threshold " << config.threshold_pct << "%)" << endl;
+            for (const auto& result : results) {
+                string key = result.dataset + "/" + result.stage;
+                auto it = baseline.find(key);
+                if (it == baseline.end() || it->second <= 0) {
+                    cout << "  " << key << ": MISSING from baseline" << endl;
+                    missing++;
+                    continue;
+                }
+                double change_pct = (result.recordsPerSec() - it->second) / it->second * 100.0;
+                bool failed = change_pct < -config.threshold_pct;
+                regressed |= failed;
+                cout << "  " << key << ": " << showpos << fixed << setprecision(1)
+                     << change_pct << "%" << noshowpos << (failed ? "  REGRESSION" : "") << endl;
+            }
+
+            // A stale or mismatched baseline must fail the gate, not skip it
+            if (missing > 0) {
+                cerr << missing << " result(s) have no baseline entry; "
+                     << "re-run with the baseline's --sizes/--instruments or --save a new one" << endl;
+            }
+            if (regressed) {
+                cerr << "Throughput regression exceeds " << config.threshold_pct << "%" << endl;
+            }
+            if (missing > 0 || regressed) {
+                return 1;
+            }
+        }
+
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
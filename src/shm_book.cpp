@@ -0,0 +1,339 @@
+#include "shm_book.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+uint32_t roundUpPow2(uint32_t value) {
+    uint32_t result = 1;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+size_t slotsOffset() {
+    return sizeof(ShmBook::Header);
+}
+
+size_t ringOffset(uint32_t max_instruments) {
+    return slotsOffset() + sizeof(ShmBook::Slot) * max_instruments;
+}
+
+runtime_error shmError(const string& what, const string& name) {
+    return runtime_error("ShmBook: " + what + " " + name + ": " + strerror(errno));
+}
+
+// Flags the region currently behind `name`, if it is ours, so readers
+// mapped to it stop waiting for updates that will never come
+void retireRegion(const string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmBook::Header)) {
+        close(fd);
+        return;
+    }
+    void* region = mmap(nullptr, sizeof(ShmBook::Header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) {
+        return;
+    }
+    auto* header = static_cast<ShmBook::Header*>(region);
+    if (header->magic == ShmBook::MAGIC && header->version == ShmBook::VERSION) {
+        header->retired.store(1, memory_order_release);
+    }
+    munmap(region, sizeof(ShmBook::Header));
+}
+
+} // namespace
+
+namespace ShmBook {
+
+size_t regionSize(uint32_t max_instruments, uint32_t ring_capacity) {
+    return ringOffset(max_instruments) + sizeof(RingEntry) * ring_capacity;
+}
+
+int64_t monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void remove(const string& name) {
+    retireRegion(name);
+    shm_unlink(name.c_str());
+}
+
+} // namespace ShmBook
+
+ShmBookPublisher::ShmBookPublisher(const string& name, uint32_t max_instruments, uint32_t ring_capacity)
+    : name(name) {
+    if (max_instruments == 0) {
+        throw runtime_error("ShmBook: max_instruments must be positive");
+    }
+    ring_capacity = roundUpPow2(max(ring_capacity, 2u));
+    region_size = ShmBook::regionSize(max_instruments, ring_capacity);
+
+    // Start from a fresh region so stale readers never see a resized layout
+    retireRegion(name);
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw shmError("cannot create", name);
+    }
+    if (ftruncate(fd, region_size) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw shmError("cannot size", name);
+    }
+    region = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw shmError("cannot map", name);
+    }
+
+    // Constructing every slot and ring entry also pre-faults the pages, so
+    // publish() never takes a page fault
+    char* base = static_cast<char*>(region);
+    slots = reinterpret_cast<ShmBook::Slot*>(base + slotsOffset());
+    ring = reinterpret_cast<ShmBook::RingEntry*>(base + ringOffset(max_instruments));
+    for (uint32_t i = 0; i < max_instruments; i++) {
+        ShmBook::Slot* slot = new (&slots[i]) ShmBook::Slot();
+        slot->instrument_id.store(-1, memory_order_relaxed);
+    }
+    for (uint32_t i = 0; i < ring_capacity; i++) {
+        new (&ring[i]) ShmBook::RingEntry();
+    }
+
+    header = new (base) ShmBook::Header();
+    header->version = ShmBook::VERSION;
+    header->max_instruments = max_instruments;
+    header->ring_capacity = ring_capacity;
+    header->num_instruments.store(0, memory_order_relaxed);
+    header->retired.store(0, memory_order_relaxed);
+    header->ring_head.store(0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    header->magic = ShmBook::MAGIC;
+}
+
+ShmBookPublisher::~ShmBookPublisher() {
+    // The region outlives the publisher so consumers can read the final book;
+    // use ShmBook::remove() to delete it
+    munmap(region, region_size);
+}
+
+uint32_t ShmBookPublisher::slotFor(int instrument_id) {
+    auto it = slot_index.find(instrument_id);
+    if (it != slot_index.end()) {
+        return it->second;
+    }
+
+    // Publication is a side channel: running out of slots must not stop the
+    // reconstruction, so the instrument is left out with a single warning
+    uint32_t slot = header->num_instruments.load(memory_order_relaxed);
+    if (slot >= header->max_instruments) {
+        cerr << "Warning: " << name << " has no free slot (max " << header->max_instruments
+             << "), not publishing instrument " << instrument_id << endl;
+        slot_index[instrument_id] = NO_SLOT;
+        return NO_SLOT;
+    }
+    slots[slot].instrument_id.store(instrument_id, memory_order_relaxed);
+    slot_index[instrument_id] = slot;
+    return slot;
+}
+
+bool ShmBookPublisher::publish(const MBPRecord& record) {
+    uint32_t slot_id = slotFor(record.instrument_id);
+    if (slot_id == NO_SLOT) {
+        return false;
+    }
+    bool first_publish = slot_id == header->num_instruments.load(memory_order_relaxed);
+    ShmBook::Slot& slot = slots[slot_id];
+
+    int64_t publish_ns = ShmBook::monotonicNs();
+
+    // Seqlock write: odd while the snapshot is inconsistent
+    uint64_t seq = slot.seq.load(memory_order_relaxed);
+    slot.seq.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    ShmBook::Snapshot& snap = slot.snapshot;
+    snap.instrument_id = record.instrument_id;
+    snap.publisher_id = record.publisher_id;
+    snap.action = record.action;
+    snap.side = record.side;
+    snap.size = record.size;
+    snap.price = record.price;
+    snap.sequence = record.sequence;
+    snap.ts_event_ns = record.ts_event_ns;
+    snap.publish_ns = publish_ns;
+    snap.update_count++;
+    for (int i = 0; i < ShmBook::DEPTH; i++) {
+        snap.bid_px[i] = record.bid_prices[i];
+        snap.bid_sz[i] = record.bid_sizes[i];
+        snap.bid_ct[i] = record.bid_counts[i];
+        snap.ask_px[i] = record.ask_prices[i];
+        snap.ask_sz[i] = record.ask_sizes[i];
+        snap.ask_ct[i] = record.ask_counts[i];
+    }
+
+    slot.seq.store(seq + 2, memory_order_release);
+
+    // Readers discover a slot only after its first snapshot is complete
+    if (first_publish) {
+        header->num_instruments.store(slot_id + 1, memory_order_release);
+    }
+
+    // Ring entry for position p is 2p+1 while writing and 2p+2 when complete
+    uint64_t pos = header->ring_head.load(memory_order_relaxed);
+    ShmBook::RingEntry& entry = ring[pos & (header->ring_capacity - 1)];
+    entry.seq.store(2 * pos + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    ShmBook::Update& update = entry.update;
+    update.instrument_id = record.instrument_id;
+    update.slot = slot_id;
+    update.action = record.action;
+    update.side = record.side;
+    update.sequence = record.sequence;
+    update.ts_event_ns = record.ts_event_ns;
+    update.publish_ns = publish_ns;
+    update.bid_px = record.bid_prices[0];
+    update.bid_sz = record.bid_sizes[0];
+    update.ask_px = record.ask_prices[0];
+    update.ask_sz = record.ask_sizes[0];
+
+    entry.seq.store(2 * pos + 2, memory_order_release);
+    header->ring_head.store(pos + 1, memory_order_release);
+    return true;
+}
+
+ShmBookReader::ShmBookReader(const string& name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw shmError("cannot open", name);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmBook::Header)) {
+        close(fd);
+        throw runtime_error("ShmBook: region too small: " + name);
+    }
+    region_size = st.st_size;
+    region = mmap(nullptr, region_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) {
+        throw shmError("cannot map", name);
+    }
+
+    const char* base = static_cast<const char*>(region);
+    header = reinterpret_cast<const ShmBook::Header*>(base);
+    if (header->magic != ShmBook::MAGIC || header->version != ShmBook::VERSION ||
+        region_size < ShmBook::regionSize(header->max_instruments, header->ring_capacity)) {
+        munmap(const_cast<void*>(region), region_size);
+        throw runtime_error("ShmBook: incompatible region: " + name);
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    slots = reinterpret_cast<const ShmBook::Slot*>(base + slotsOffset());
+    ring = reinterpret_cast<const ShmBook::RingEntry*>(base + ringOffset(header->max_instruments));
+    cursor = header->ring_head.load(memory_order_acquire);
+}
+
+ShmBookReader::~ShmBookReader() {
+    munmap(const_cast<void*>(region), region_size);
+}
+
+bool ShmBookReader::findSlot(int instrument_id, uint32_t& slot) {
+    auto it = slot_cache.find(instrument_id);
+    if (it != slot_cache.end()) {
+        slot = it->second;
+        return true;
+    }
+
+    // Slots are claimed in order and never reassigned, so a miss only needs
+    // to scan the ones published since the last lookup
+    uint32_t count = header->num_instruments.load(memory_order_acquire);
+    for (uint32_t i = slot_cache.size(); i < count; i++) {
+        slot_cache[slots[i].instrument_id.load(memory_order_relaxed)] = i;
+    }
+
+    it = slot_cache.find(instrument_id);
+    if (it == slot_cache.end()) {
+        return false;
+    }
+    slot = it->second;
+    return true;
+}
+
+bool ShmBookReader::readSlot(uint32_t slot_id, ShmBook::Snapshot& out) const {
+    const ShmBook::Slot& slot = slots[slot_id];
+    uint64_t before = slot.seq.load(memory_order_acquire);
+    if (before & 1) {
+        return false;
+    }
+    memcpy(&out, &slot.snapshot, sizeof(out));
+    atomic_thread_fence(memory_order_acquire);
+    return slot.seq.load(memory_order_relaxed) == before;
+}
+
+bool ShmBookReader::tryReadLatest(int instrument_id, ShmBook::Snapshot& out) {
+    uint32_t slot;
+    return findSlot(instrument_id, slot) && readSlot(slot, out);
+}
+
+bool ShmBookReader::readLatest(int instrument_id, ShmBook::Snapshot& out, int max_retries) {
+    uint32_t slot;
+    if (!findSlot(instrument_id, slot)) {
+        return false;
+    }
+    for (int attempt = 0; attempt < max(1, max_retries); attempt++) {
+        if (readSlot(slot, out)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ShmBookReader::nextUpdate(ShmBook::Update& out) {
+    const uint64_t capacity = header->ring_capacity;
+
+    while (true) {
+        const ShmBook::RingEntry& entry = ring[cursor & (capacity - 1)];
+        uint64_t expected = 2 * cursor + 2;
+        uint64_t before = entry.seq.load(memory_order_acquire);
+
+        if (before == expected) {
+            memcpy(&out, &entry.update, sizeof(out));
+            atomic_thread_fence(memory_order_acquire);
+            if (entry.seq.load(memory_order_relaxed) == expected) {
+                cursor++;
+                return true;
+            }
+        } else if (before < expected) {
+            return false; // not published yet
+        }
+
+        // Lapped by the publisher: skip to the oldest entry still in the ring
+        uint64_t head = header->ring_head.load(memory_order_acquire);
+        uint64_t oldest = head > capacity ? head - capacity : 0;
+        if (oldest > cursor) {
+            dropped += oldest - cursor;
+            cursor = oldest;
+        } else {
+            cursor++;
+            dropped++;
+        }
+    }
+}
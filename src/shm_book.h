@@ -0,0 +1,167 @@
+#pragma once
+#include "orderbook.h"
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+
+using namespace std;
+
+// Shared-memory MBP-10 publication for local consumers.
+//
+// Region layout (POSIX shm, created by the publisher):
+//   Header | Slot[max_instruments] | RingEntry[ring_capacity]
+//
+// Each Slot holds the latest top-10 book of one instrument behind a seqlock:
+// the publisher makes `seq` odd while writing and even when done, readers
+// copy the snapshot and retry if `seq` changed. The ring holds recent
+// top-of-book updates across all instruments; entry for position p carries
+// seq 2p+2 once complete, so readers can detect both "not yet written" and
+// "overwritten" without locks. There is a single publisher per region.
+//
+// Recreating or removing a region sets `retired` in the old one first, so
+// readers still mapped to it can tell a replaced book from a quiet market
+// and reopen the name.
+namespace ShmBook {
+    const uint64_t MAGIC = 0x4b4f4f4250424d53ULL; // "SMBPBOOK"
+    const uint32_t VERSION = 2;
+    const int DEPTH = 10;
+
+    struct Snapshot {
+        int32_t instrument_id;
+        int32_t publisher_id;
+        char action;
+        char side;
+        int32_t size;
+        double price;
+        int64_t sequence;
+        int64_t ts_event_ns;    // exchange timestamp, ns since epoch
+        int64_t publish_ns;     // CLOCK_MONOTONIC at publish, for staleness
+        uint64_t update_count;  // snapshots published for this instrument
+
+        double bid_px[DEPTH];
+        int32_t bid_sz[DEPTH];
+        int32_t bid_ct[DEPTH];
+        double ask_px[DEPTH];
+        int32_t ask_sz[DEPTH];
+        int32_t ask_ct[DEPTH];
+    };
+
+    struct Update {
+        int32_t instrument_id;
+        uint32_t slot;
+        char action;
+        char side;
+        int64_t sequence;
+        int64_t ts_event_ns;
+        int64_t publish_ns;
+        double bid_px;
+        int32_t bid_sz;
+        double ask_px;
+        int32_t ask_sz;
+    };
+
+    struct alignas(64) Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t max_instruments;
+        uint32_t ring_capacity; // power of two
+        atomic<uint32_t> num_instruments;
+        atomic<uint32_t> retired;               // nonzero once replaced or removed
+        alignas(64) atomic<uint64_t> ring_head; // next ring position to be written
+    };
+
+    struct alignas(64) Slot {
+        atomic<uint64_t> seq;
+        atomic<int32_t> instrument_id;
+        Snapshot snapshot;
+    };
+
+    struct alignas(64) RingEntry {
+        atomic<uint64_t> seq;
+        Update update;
+    };
+
+    static_assert(atomic<uint64_t>::is_always_lock_free, "shared-memory atomics must be lock-free");
+    static_assert(atomic<uint32_t>::is_always_lock_free, "shared-memory atomics must be lock-free");
+
+    size_t regionSize(uint32_t max_instruments, uint32_t ring_capacity);
+
+    // Monotonic clock shared by all processes on the host (vDSO, no syscall)
+    int64_t monotonicNs();
+
+    // Removes the named region; mapped readers keep their view but see it
+    // as retired
+    void remove(const string& name);
+}
+
+class ShmBookPublisher {
+private:
+    string name;
+    size_t region_size;
+    void* region;
+    ShmBook::Header* header;
+    ShmBook::Slot* slots;
+    ShmBook::RingEntry* ring;
+    unordered_map<int, uint32_t> slot_index; // NO_SLOT for instruments left out
+
+    static const uint32_t NO_SLOT = UINT32_MAX;
+
+    uint32_t slotFor(int instrument_id);
+
+public:
+    // Creates (or recreates) the region `name`, e.g. "/mbp_book". An existing
+    // region is marked retired before it is replaced.
+    ShmBookPublisher(const string& name, uint32_t max_instruments = 64, uint32_t ring_capacity = 4096);
+    ~ShmBookPublisher();
+
+    ShmBookPublisher(const ShmBookPublisher&) = delete;
+    ShmBookPublisher& operator=(const ShmBookPublisher&) = delete;
+
+    // Publishes the snapshot; false if the instrument did not fit in
+    // max_instruments slots (warned about once, then skipped silently)
+    bool publish(const MBPRecord& record);
+};
+
+class ShmBookReader {
+private:
+    size_t region_size;
+    const void* region;
+    const ShmBook::Header* header;
+    const ShmBook::Slot* slots;
+    const ShmBook::RingEntry* ring;
+    unordered_map<int, uint32_t> slot_cache;
+    uint64_t cursor;
+    uint64_t dropped = 0;
+
+    bool findSlot(int instrument_id, uint32_t& slot);
+    bool readSlot(uint32_t slot_id, ShmBook::Snapshot& out) const;
+
+public:
+    // Maps an existing region read-only; the update cursor starts at the
+    // current ring head, so only updates published after this are seen
+    explicit ShmBookReader(const string& name);
+    ~ShmBookReader();
+
+    ShmBookReader(const ShmBookReader&) = delete;
+    ShmBookReader& operator=(const ShmBookReader&) = delete;
+
+    // Single seqlock attempt; false if the instrument is unknown or the
+    // publisher was mid-write
+    bool tryReadLatest(int instrument_id, ShmBook::Snapshot& out);
+
+    // Retries the seqlock read up to max_retries times, so the call is
+    // bounded even if the publisher died mid-write. False if the instrument
+    // has never been published or no consistent snapshot was read within
+    // max_retries attempts.
+    bool readLatest(int instrument_id, ShmBook::Snapshot& out, int max_retries = 1024);
+
+    // Next ring update, if any. Updates overwritten before they were read
+    // are skipped and counted in droppedUpdates()
+    bool nextUpdate(ShmBook::Update& out);
+
+    uint64_t droppedUpdates() const { return dropped; }
+
+    // True once the region was replaced by a new publisher or removed; no
+    // further updates will arrive, so reopen the name to follow the new one
+    bool retired() const { return header->retired.load(memory_order_acquire) != 0; }
+};
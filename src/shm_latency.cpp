@@ -0,0 +1,233 @@
+#include "shm_book.h"
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Publisher -> consumer latency through the shared-memory book. The
+// publisher and each consumer process are pinned to separate cores when the
+// machine has enough of them; latency is measured per ring update as
+// CLOCK_MONOTONIC at read minus the publish timestamp stored in the update.
+
+struct LatencyConfig {
+    string shm_name = "/mbp_book_latency";
+    int consumers = 2;
+    long updates = 200000;
+    int instruments = 8;
+    long pace_ns = 1000; // gap between publishes
+};
+
+static bool pinToCore(int core) {
+    long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % max(1L, num_cores), &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+static void spinUntil(int64_t deadline_ns) {
+    while (ShmBook::monotonicNs() < deadline_ns) {
+    }
+}
+
+static int runConsumer(const LatencyConfig& config, int index, bool shared_core) {
+    pinToCore(index + 1);
+
+    ShmBookReader reader(config.shm_name);
+    vector<int64_t> latencies;
+    latencies.reserve(config.updates);
+
+    ShmBook::Update update;
+    ShmBook::Snapshot snapshot;
+    long seen = 0;
+    long book_reads = 0;
+    int64_t idle_since = ShmBook::monotonicNs();
+
+    // The final update is never overwritten, so seeing it marks the end
+    bool done = false;
+    while (!done) {
+        if (reader.nextUpdate(update)) {
+            int64_t now = ShmBook::monotonicNs();
+            latencies.push_back(now - update.publish_ns);
+            seen++;
+            idle_since = now;
+            done = update.sequence == config.updates - 1;
+
+            // Every few updates also pull the full book, as a strategy would
+            if (seen % 16 == 0 && reader.readLatest(update.instrument_id, snapshot)) {
+                book_reads++;
+            }
+            continue;
+        }
+
+        if (ShmBook::monotonicNs() - idle_since > 5000000000LL) {
+            cerr << "consumer " << index << ": timed out after " << seen << " updates" << endl;
+            return 1;
+        }
+        if (shared_core) {
+            sched_yield();
+        }
+    }
+
+    sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) {
+        return latencies.empty() ? 0 : latencies[min(latencies.size() - 1, (size_t)(p * latencies.size()))];
+    };
+
+    // One line per consumer so concurrent output stays readable
+    char line[256];
+    snprintf(line, sizeof(line),
+             "consumer %d: %ld updates, %llu dropped, %ld book reads | latency ns p50=%lld p99=%lld p99.9=%lld max=%lld\n",
+             index, seen, (unsigned long long)reader.droppedUpdates(), book_reads,
+             (long long)pct(0.50), (long long)pct(0.99), (long long)pct(0.999),
+             (long long)(latencies.empty() ? 0 : latencies.back()));
+    cout << line << flush;
+    return 0;
+}
+
+static void runPublisher(const LatencyConfig& config, ShmBookPublisher& publisher) {
+    pinToCore(0);
+
+    MBPRecord record;
+    record.ts_recv = "2025-07-17T08:05:03.360677248Z";
+    record.ts_event = "2025-07-17T08:05:03.360677248Z";
+    record.ts_event_ns = Timestamp::parse(record.ts_event);
+    record.rtype = 10;
+    record.publisher_id = 2;
+    record.action = 'A';
+    record.side = 'B';
+    record.depth = 0;
+    record.flags = 130;
+    record.ts_in_delta = 0;
+    record.symbol = "LAT";
+    record.order_id = 0;
+
+    int64_t next = ShmBook::monotonicNs();
+    for (long i = 0; i < config.updates; i++) {
+        record.instrument_id = 1100 + (int)(i % config.instruments);
+        record.sequence = i;
+        record.price = 10.00 + (i % 7) * 0.01;
+        record.size = 100;
+        for (int level = 0; level < ShmBook::DEPTH; level++) {
+            record.bid_prices[level] = record.price - level * 0.01;
+            record.bid_sizes[level] = 100 + level;
+            record.bid_counts[level] = 1;
+            record.ask_prices[level] = record.price + (level + 1) * 0.01;
+            record.ask_sizes[level] = 100 + level;
+            record.ask_counts[level] = 1;
+        }
+
+        next += config.pace_ns;
+        spinUntil(next);
+        publisher.publish(record);
+    }
+}
+
+// Parses an integer in [min_value, max_value]; false on anything else
+static bool parseBounded(const string& arg, long min_value, long max_value, long& value) {
+    size_t consumed = 0;
+    try {
+        value = stol(arg, &consumed);
+    } catch (const exception&) {
+        return false;
+    }
+    return consumed == arg.size() && value >= min_value && value <= max_value;
+}
+
+static void usage(const char* prog) {
+    cerr << "Usage: " << prog
+         << " [--name /shm_name] [--consumers N] [--updates N] [--instruments N] [--pace-ns N]" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    LatencyConfig config;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        string value = argv[++i];
+        long parsed = 0;
+        if (arg == "--name") {
+            config.shm_name = value;
+        } else if (arg == "--consumers" && parseBounded(value, 1, 1024, parsed)) {
+            config.consumers = parsed;
+        } else if (arg == "--updates" && parseBounded(value, 1, numeric_limits<long>::max(), parsed)) {
+            config.updates = parsed;
+        } else if (arg == "--instruments" && parseBounded(value, 1, numeric_limits<int>::max(), parsed)) {
+            config.instruments = parsed;
+        } else if (arg == "--pace-ns" && parseBounded(value, 0, numeric_limits<long>::max(), parsed)) {
+            config.pace_ns = parsed;
+        } else {
+            cerr << "Invalid argument: " << arg << " " << value << endl;
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    bool shared_core = num_cores < config.consumers + 1;
+    cout << "Shared-memory latency test: " << config.consumers << " consumers, "
+         << config.updates << " updates over " << config.instruments << " instruments, "
+         << config.pace_ns << " ns pacing, " << num_cores << " cores" << endl;
+    if (shared_core) {
+        cout << "Warning: fewer cores than processes, consumers yield when idle "
+             << "and latencies include scheduling delay" << endl;
+    }
+
+    try {
+        // Large enough that a consumer keeping up never gets lapped
+        ShmBookPublisher publisher(config.shm_name, config.instruments, 65536);
+
+        vector<pid_t> children;
+        for (int c = 0; c < config.consumers; c++) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                throw runtime_error("fork failed");
+            }
+            if (pid == 0) {
+                int rc;
+                try {
+                    rc = runConsumer(config, c, shared_core);
+                } catch (const exception& e) {
+                    cerr << "consumer " << c << ": " << e.what() << endl;
+                    rc = 1;
+                }
+                _exit(rc);
+            }
+            children.push_back(pid);
+        }
+
+        // Give consumers time to map the region and position their cursors
+        usleep(200000);
+        runPublisher(config, publisher);
+
+        int failures = 0;
+        for (pid_t pid : children) {
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                failures++;
+            }
+        }
+        ShmBook::remove(config.shm_name);
+
+        if (failures > 0) {
+            cerr << failures << " consumer(s) failed" << endl;
+            return 1;
+        }
+
+    } catch (const exception& e) {
+        ShmBook::remove(config.shm_name);
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,5 +1,12 @@
 #include "orderbook.h"
+#include "columnar.h"
+#include "shm_book.h"
 #include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <iostream>
 #include <vector>
 
@@ -129,6 +136,8 @@ void test_csv_parsing() {
     assert(record.size == 100);
     assert(record.order_id == 817593);
     assert(record.symbol == "ARL");
+    assert(record.ts_event_ns == 1752739503360677248LL);
+    assert(Timestamp::format(record.ts_event_ns) == "2025-07-17T08:05:03.360677248Z");
     
     cout << "✓ CSV parsing test passed" << endl;
 }
@@ -196,6 +205,203 @@ void test_edge_cases() {
     cout << "✓ Edge cases test passed" << endl;
 }
 
+void test_columnar_roundtrip() {
+    cout << "Testing columnar round trip..." << endl;
+    
+    vector<MBPRecord> records;
+    for (int i = 0; i < 5; i++) {
+        MBPRecord record;
+        record.ts_recv = "2025-07-17T08:05:03.36067724" + to_string(i) + "Z";
+        record.ts_event = "2025-07-17T08:05:03.360677248Z";
+        record.ts_event_ns = Timestamp::parse(record.ts_event);
+        record.rtype = 10;
+        record.publisher_id = 2;
+        record.instrument_id = 1108;
+        record.action = 'A';
+        record.side = i % 2 ? 'A' : 'B';
+        record.depth = 0;
+        record.price = 5.51 + i * 0.01;
+        record.size = 100;
+        record.flags = 130;
+        record.ts_in_delta = 165200;
+        record.sequence = 851012 + i;
+        record.bid_prices[0] = 5.51;
+        record.bid_sizes[0] = 100 * (i + 1);
+        record.bid_counts[0] = i + 1;
+        record.ask_prices[0] = 5.53 + i * 0.01;
+        record.ask_sizes[0] = 50;
+        record.ask_counts[0] = 1;
+        record.symbol = i < 3 ? "ARL" : "XYZ";
+        record.order_id = 817593 + i;
+        records.push_back(record);
+    }
+    
+    // Small row groups so the file spans several of them
+    string filename = "test_columnar.mbpc";
+    {
+        ColumnarWriter writer(filename, 2);
+        for (const auto& record : records) {
+            writer.append(record);
+        }
+    }
+    
+    vector<MBPRecord> decoded = ColumnarReader::readMBP(filename);
+    assert(decoded.size() == records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        assert(CSVProcessor::formatMBPLine(decoded[i], i) == CSVProcessor::formatMBPLine(records[i], i));
+    }
+    
+    // Dropping the one-byte trailer leaves whole row groups, but the file
+    // must still read as truncated
+    ifstream in(filename, ios::binary);
+    string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+    ofstream(filename, ios::binary).write(bytes.data(), bytes.size() - 1);
+    bool threw = false;
+    try {
+        ColumnarReader::readMBP(filename);
+    } catch (const runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    
+    remove(filename.c_str());
+    
+    cout << "✓ Columnar round trip test passed" << endl;
+}
+
+void test_columnar_column_scan() {
+    cout << "Testing columnar column scan..." << endl;
+    
+    OrderBook book;
+    vector<MBPRecord> records;
+    MBORecord dummy_mbo = {};
+    dummy_mbo.ts_recv = "2025-07-17T08:05:03.360677248Z";
+    dummy_mbo.ts_event = "2025-07-17T08:05:03.360677248Z";
+    dummy_mbo.ts_event_ns = Timestamp::parse(dummy_mbo.ts_event);
+    dummy_mbo.symbol = "ARL";
+    for (int i = 0; i < 1000; i++) {
+        book.addOrder('B', 10.00 + (i % 5) * 0.01, 100, i + 1);
+        book.addOrder('A', 10.10 + (i % 5) * 0.01, 100, i + 10001);
+        records.push_back(book.generateMBP(dummy_mbo));
+    }
+    
+    string filename = "test_columnar_scan.mbpc";
+    ColumnarWriter::writeMBP(records, filename);
+    
+    ColumnarReader reader(filename);
+    auto columns = reader.scanColumns({"bid_px_00", "ask_px_00"});
+    
+    assert(columns.size() == 2);
+    assert(columns["bid_px_00"].size() == records.size());
+    assert(columns["ask_px_00"].size() == records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        assert(Columnar::fromFixed(columns["bid_px_00"][i]) == records[i].bid_prices[0]);
+        assert(Columnar::fromFixed(columns["ask_px_00"][i]) == records[i].ask_prices[0]);
+    }
+    
+    // Typos and string columns must not look like empty integer columns
+    for (const char* bad : {"nope", "symbol"}) {
+        bool threw = false;
+        try {
+            ColumnarReader(filename).scanColumns({"bid_px_00", bad});
+        } catch (const runtime_error&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+    
+    remove(filename.c_str());
+    
+    cout << "✓ Columnar column scan test passed" << endl;
+}
+
+void test_shm_publish_read() {
+    cout << "Testing shared-memory publish/read..." << endl;
+    
+    string name = "/mbp_book_test_" + to_string(getpid());
+    ShmBookPublisher publisher(name, 4, 8);
+    ShmBookReader reader(name);
+    
+    OrderBook book;
+    book.addOrder('B', 10.50, 100, 1001);
+    book.addOrder('A', 10.75, 150, 1002);
+    
+    MBORecord dummy_mbo = {};
+    dummy_mbo.ts_event = "2025-07-17T08:05:03.360677248Z";
+    dummy_mbo.ts_event_ns = Timestamp::parse(dummy_mbo.ts_event);
+    dummy_mbo.instrument_id = 1108;
+    dummy_mbo.action = 'A';
+    dummy_mbo.side = 'A';
+    dummy_mbo.sequence = 42;
+    dummy_mbo.symbol = "ARL";
+    publisher.publish(book.generateMBP(dummy_mbo));
+    
+    ShmBook::Snapshot snapshot;
+    assert(!reader.readLatest(9999, snapshot));  // Unknown instrument
+    assert(reader.readLatest(1108, snapshot));
+    assert(snapshot.bid_px[0] == 10.50);
+    assert(snapshot.bid_sz[0] == 100);
+    assert(snapshot.ask_px[0] == 10.75);
+    assert(snapshot.ask_sz[0] == 150);
+    assert(snapshot.sequence == 42);
+    assert(snapshot.ts_event_ns == dummy_mbo.ts_event_ns);
+    assert(snapshot.update_count == 1);
+    
+    ShmBook::Update update;
+    assert(reader.nextUpdate(update));
+    assert(update.instrument_id == 1108);
+    assert(update.bid_px == 10.50 && update.ask_px == 10.75);
+    assert(!reader.nextUpdate(update));
+    
+    // Overrunning the 8-entry ring skips to the oldest surviving update
+    for (int i = 0; i < 20; i++) {
+        dummy_mbo.sequence = 100 + i;
+        publisher.publish(book.generateMBP(dummy_mbo));
+    }
+    assert(reader.nextUpdate(update));
+    assert(update.sequence == 112);
+    assert(reader.droppedUpdates() == 12);
+    
+    // A publisher that died mid-write leaves the slot's seq odd; readers must
+    // give up instead of spinning forever
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    assert(fd >= 0);
+    size_t region_size = ShmBook::regionSize(4, 8);
+    void* region = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    assert(region != MAP_FAILED);
+    auto* slot = reinterpret_cast<ShmBook::Slot*>(static_cast<char*>(region) + sizeof(ShmBook::Header));
+    slot->seq.fetch_add(1);
+    assert(!reader.readLatest(1108, snapshot, 16));
+    assert(!reader.tryReadLatest(1108, snapshot));
+    slot->seq.fetch_add(1);
+    assert(reader.readLatest(1108, snapshot));
+    munmap(region, region_size);
+    
+    // Running out of slots skips the instrument instead of throwing
+    for (int id = 2000; id < 2004; id++) {
+        dummy_mbo.instrument_id = id;
+        bool published = publisher.publish(book.generateMBP(dummy_mbo));
+        assert(published == (id < 2003));  // 4 slots, 1108 holds the first
+    }
+    assert(reader.readLatest(2002, snapshot));
+    assert(!reader.readLatest(2003, snapshot));
+    
+    // A new publisher on the same name retires the region old readers map
+    assert(!reader.retired());
+    ShmBookPublisher replacement(name, 4, 8);
+    assert(reader.retired());
+    ShmBookReader fresh_reader(name);
+    assert(!fresh_reader.retired());
+    assert(!fresh_reader.readLatest(1108, snapshot));
+    
+    ShmBook::remove(name);
+    assert(fresh_reader.retired());
+    
+    cout << "✓ Shared-memory publish/read test passed" << endl;
+}
+
 void run_performance_test() {
     cout << "Running performance test..." << endl;
     
@@ -241,6 +447,9 @@ int main() {
         test_csv_parsing();
         test_mbp_formatting();
         test_edge_cases();
+        test_columnar_roundtrip();
+        test_columnar_column_scan();
+        test_shm_publish_read();
         run_performance_test();
         
         cout << "\n✅ ALL TESTS PASSED!" << endl;